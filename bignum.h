@@ -1,9 +1,13 @@
+#ifndef BIGNUM_H
+#define BIGNUM_H
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 /* This assert must succeed for this code to work */
 //#include <assert.h>
@@ -15,6 +19,7 @@ typedef unsigned long long ullong;
 #define BN_MAX_WORDS 512 
 #define BN_FIRST_BIT_OF_HIGH_WORD (ullong) 0b100000000000000000000000000000000
 #define BN_WORD_SIZE (sizeof(uint) * 8)
+#define BN_WORKSPACE_MAX_SLOTS 32
 
 #define BN_LOWER_WORD(l) (l & UINT_MAX)
 #define BN_UPPER_WORD(l) (l >> BN_WORD_SIZE)
@@ -36,6 +41,49 @@ struct bignum {
     int sign;
 };
 
+/*********************************************************************************************************\
+ *  Each bnReducer holds the running residue of a byte stream modulo a bignum N of n words. Bytes are    *
+ *  read as one big-endian number, and are folded in n words at a time.                                  *
+ *  modulus is N << normShift, so that its top bit is set, and residue is kept scaled by the same shift. *
+ *  table + i * n = 2^(32 * (n + i)) % modulus for i <= n, so folding a block in is n word * table       *
+ *  multiply-accumulates followed by a few conditional subtracts.                                        *
+ *  All arrays live in one heap block of about (n + 2)^2 words owned by memory, sized by initBnReducer   *
+ *  and released by freeBnReducer.                                                                       *
+\*********************************************************************************************************/
+struct bnReducer {
+    uint* memory;
+    uint* modulus;
+    uint* table;
+    uint* residue;
+    uint* acc;
+    uint* block;
+    int modulusWords;
+    int normShift;
+    int filledWords;
+    uint pendingWord;
+    int pendingBytes;
+};
+
+/*********************************************************************************************************\
+ *  Each bnWorkspace is a stack of scratch bignums. Slots are allocated on first use and kept until      *
+ *  freeBnWorkspace, so repeated calls reuse the same memory instead of growing the call stack.          *
+ *  used is the current depth, allocated the number of slots in memory, and highWater the deepest use.   *
+\*********************************************************************************************************/
+struct bnWorkspace {
+    struct bignum* slots[BN_WORKSPACE_MAX_SLOTS];
+    int used;
+    int allocated;
+    int highWater;
+};
+
+/* Per-thread workspaces: the built-in one, and an optional caller-owned override */
+__thread struct bnWorkspace bnThreadWorkspace;
+__thread struct bnWorkspace* bnCurrentWorkspace;
+
+/* Frees each thread's built-in workspace when the thread exits */
+pthread_key_t bnWorkspaceKey;
+pthread_once_t bnWorkspaceKeyOnce = PTHREAD_ONCE_INIT;
+
 /* Useful pre-initalized bignums */
 struct bignum emptyBn = {{0}, 0, 1};
 struct bignum oneBn = {{1}, 0, 1};
@@ -45,6 +93,15 @@ struct bignum oneBn = {{1}, 0, 1};
  * All functions follow the pattern of value args: inputs & reference args: outputs                      *
 \*********************************************************************************************************/
 
+/* Workspace functions */
+extern struct bnWorkspace* getBnWorkspace(void);
+extern void setBnWorkspace(struct bnWorkspace* workspace);
+extern struct bignum* takeBnWorkspace(struct bnWorkspace* workspace);
+extern void releaseBnWorkspace(struct bnWorkspace* workspace, int count);
+extern void freeBnWorkspace(struct bnWorkspace* workspace);
+extern void freeBnWorkspaceAtExit(void* workspace);
+extern void createBnWorkspaceKey(void);
+
 /* Bignum initialization functions */
 extern void initBn(struct bignum* bn, uint number[], int highestWord, int sign);
 extern void initBnUll(struct bignum* bn, ullong number, int sign);
@@ -56,12 +113,15 @@ extern void printBn(struct bignum bn, bool blocks);
 
 /* Compare functions */
 extern int  compareBn(struct bignum a, struct bignum b);
+extern int  compareBnRef(struct bignum const* a, struct bignum const* b);
 extern bool compareBnIgnoreSize(struct bignum a, struct bignum b);
 
 /* Simple bit manipulation functions */
 extern void flipBitBn(struct bignum a, int bitIndex, struct bignum *out);
 extern void shiftBn(struct bignum a, int shift, struct bignum* out);
 extern void bitShiftBn(struct bignum a, int shift, struct bignum* out);
+extern void bitShiftBnRef(struct bignum const* a, int shift, struct bignum* out);
+
 
 /* Logic bit manipulation functions */
 extern void orBnBn(struct bignum a, struct bignum b, struct bignum* out);
@@ -69,10 +129,10 @@ extern void andBnBn(struct bignum a, struct bignum b, struct bignum* out);
 extern void xorBnBn(struct bignum a, struct bignum b, struct bignum* out);
 
 /* Arithmetic functions which ignore sign of bignum (not typically used by user) */
-extern void addBnBnNS(struct bignum a, struct bignum b, struct bignum* out);
-extern void subBnBnNS(struct bignum a, struct bignum b, struct bignum* out);
-extern void mulBnBnNS(struct bignum a, struct bignum b, struct bignum* out);
-extern void divBnBnNS(struct bignum a, struct bignum b, struct bignum* out, struct bignum* remainder);
+extern void addBnBnNS(struct bignum const* a, struct bignum const* b, struct bignum* out);
+extern void subBnBnNS(struct bignum const* a, struct bignum const* b, struct bignum* out);
+extern void mulBnBnNS(struct bignum const* a, struct bignum const* b, struct bignum* out);
+extern void divBnBnNS(struct bignum const* a, struct bignum const* b, struct bignum* out, struct bignum* remainder);
 
 /* Arithmetic functions */
 extern void addBnBn(struct bignum a, struct bignum b, struct bignum* out);
@@ -80,11 +140,118 @@ extern void subBnBn(struct bignum a, struct bignum b, struct bignum* out);
 extern void mulBnBn(struct bignum a, struct bignum b, struct bignum* out);
 extern void divBnBn(struct bignum a, struct bignum b, struct bignum* out, struct bignum* remainder);
 
+/* Arithmetic functions taking inputs by pointer (use these on small stacks) */
+extern void addBnBnRef(struct bignum const* a, struct bignum const* b, struct bignum* out);
+extern void subBnBnRef(struct bignum const* a, struct bignum const* b, struct bignum* out);
+extern void mulBnBnRef(struct bignum const* a, struct bignum const* b, struct bignum* out);
+extern void divBnBnRef(struct bignum const* a, struct bignum const* b, struct bignum* out, struct bignum* remainder);
+extern void modBnBnRef(struct bignum const* a, struct bignum const* b, struct bignum* out);
+
 /* Complex math functions */
 extern void modBnBn(struct bignum a, struct bignum b, struct bignum* out);
 extern void gcdBn(struct bignum a, struct bignum b, struct bignum* d, struct bignum* x, struct bignum* y);
 extern void modExponentiation(struct bignum base, struct bignum exponent, struct bignum modulus, struct bignum* out);
+extern void gcdBnRef(struct bignum const* a, struct bignum const* b, struct bignum* d, struct bignum* x, struct bignum* y);
+extern void modExponentiationRef(struct bignum const* base, struct bignum const* exponent, struct bignum const* modulus, struct bignum* out);
+
+/* Streaming reduction functions */
+extern bool initBnReducer(struct bnReducer* reducer, struct bignum const* modulus);
+extern void feedBnReducer(struct bnReducer* reducer, unsigned char const bytes[], size_t length);
+extern void finalBnReducer(struct bnReducer* reducer, struct bignum* out);
+extern void freeBnReducer(struct bnReducer* reducer);
+extern void addMulBnReducer(struct bnReducer* reducer, int offset, uint const x[], int length, uint w);
+extern void foldBnReducer(struct bnReducer* reducer);
+
+
+/*********************************************************************************************************\
+ * getBnWorkspace returns the workspace used by the calling thread.                                      *
+\*********************************************************************************************************/
+struct bnWorkspace* getBnWorkspace(void) {
+    if (bnCurrentWorkspace == NULL) {
+        return &bnThreadWorkspace;
+    }
+    return bnCurrentWorkspace;
+}
+
+/*********************************************************************************************************\
+ * setBnWorkspace makes the calling thread use a caller-owned workspace (NULL restores the default).     *
+ * Note: workspace must be zero-initialized before first use, e.g. struct bnWorkspace ws = {0}.          *
+\*********************************************************************************************************/
+void setBnWorkspace(struct bnWorkspace* workspace) {
+    bnCurrentWorkspace = workspace;
+}
+
+/*********************************************************************************************************\
+ * takeBnWorkspace pushes a scratch bignum onto the workspace. Its contents are undefined.               *
+\*********************************************************************************************************/
+struct bignum* takeBnWorkspace(struct bnWorkspace* workspace) {
+    if (workspace->used == BN_WORKSPACE_MAX_SLOTS) {
+        fprintf(stderr, "bignum: workspace exhausted (%d slots)\n", BN_WORKSPACE_MAX_SLOTS);
+        abort();
+    }
+
+    if (workspace->used == workspace->allocated) {
+        if (workspace == &bnThreadWorkspace && workspace->allocated == 0) {
+            pthread_once(&bnWorkspaceKeyOnce, createBnWorkspaceKey);
+            pthread_setspecific(bnWorkspaceKey, workspace);
+        }
+
+        workspace->slots[workspace->allocated] = (struct bignum*) malloc(sizeof(struct bignum));
+        if (workspace->slots[workspace->allocated] == NULL) {
+            fprintf(stderr, "bignum: out of memory for workspace\n");
+            abort();
+        }
+        workspace->allocated++;
+    }
+
+    workspace->used++;
+    if (workspace->used > workspace->highWater) {
+        workspace->highWater = workspace->used;
+    }
+
+    return workspace->slots[workspace->used - 1];
+}
+
+/*********************************************************************************************************\
+ * releaseBnWorkspace pops the last count scratch bignums taken from the workspace.                      *
+\*********************************************************************************************************/
+void releaseBnWorkspace(struct bnWorkspace* workspace, int count) {
+    if (count < 0 || count > workspace->used) {
+        fprintf(stderr, "bignum: releasing %d workspace slots with only %d in use\n", count, workspace->used);
+        abort();
+    }
+    workspace->used -= count;
+}
+
+/*********************************************************************************************************\
+ * freeBnWorkspace returns the memory held by a workspace. Statistics are kept.                          *
+ * Note: Each thread's built-in workspace is freed automatically when the thread exits. A caller-owned   *
+ *       workspace installed with setBnWorkspace must be freed by its owner.                             *
+\*********************************************************************************************************/
+void freeBnWorkspace(struct bnWorkspace* workspace) {
+    for (int i = 0; i < workspace->allocated; i++) {
+        free(workspace->slots[i]);
+        workspace->slots[i] = NULL;
+    }
+    workspace->used = 0;
+    workspace->allocated = 0;
+}
 
+/*********************************************************************************************************\
+ * freeBnWorkspaceAtExit is the thread-exit destructor registered for bnWorkspaceKey.                    *
+ * Note: Helper function not intended for use by user.                                                   *
+\*********************************************************************************************************/
+void freeBnWorkspaceAtExit(void* workspace) {
+    freeBnWorkspace((struct bnWorkspace*) workspace);
+}
+
+/*********************************************************************************************************\
+ * createBnWorkspaceKey creates bnWorkspaceKey once per process.                                         *
+ * Note: Helper function not intended for use by user.                                                   *
+\*********************************************************************************************************/
+void createBnWorkspaceKey(void) {
+    pthread_key_create(&bnWorkspaceKey, freeBnWorkspaceAtExit);
+}
 
 /*********************************************************************************************************\
  * initBn initializes a bignum with an array of words.                                                   *
@@ -185,23 +352,28 @@ void printBn(struct bignum bn, bool blocks) {
  *  Note: Sign of bignum is ignored                                                                      *
 \*********************************************************************************************************/
 int compareBn(struct bignum a, struct bignum b) {
-    if (a.highestWord > b.highestWord) {
+    return compareBnRef(&a, &b);
+}
+
+/*********************************************************************************************************\
+ *  compareBnRef functions the same as compareBn, but takes its inputs by pointer.                       *
+ *  Note: Helper function not intended for use by user.                                                  *
+\*********************************************************************************************************/
+int compareBnRef(struct bignum const* a, struct bignum const* b) {
+    if (a->highestWord > b->highestWord) {
         return 1;
-    } else if (a.highestWord < b.highestWord) {
+    } else if (a->highestWord < b->highestWord) {
         return -1;
-    } else {
-        if (a.number[a.highestWord] > b.number[b.highestWord]) {
+    }
+
+    for (int i = a->highestWord; i >= 0; i--) {
+        if (a->number[i] > b->number[i]) {
             return 1; 
-        } else if (a.number[a.highestWord] < b.number[b.highestWord]) {
+        } else if (a->number[i] < b->number[i]) {
             return -1;
-        } else if (a.highestWord == 0) {
-            return 0;
-        } else {
-            a.highestWord--;
-            b.highestWord--;
-            return compareBn(a, b);
         }
     }
+    return 0;
 }
 
 /*********************************************************************************************************\
@@ -261,23 +433,31 @@ void shiftBn(struct bignum a, int shift, struct bignum *out) {
  *  Note: shift can by positive or negative for a right or left shift respectively.                      *
 \*********************************************************************************************************/
 void bitShiftBn(struct bignum a, int shift, struct bignum* out) {
+    bitShiftBnRef(&a, shift, out);
+}
+
+/*********************************************************************************************************\
+ *  bitShiftBnRef functions the same as bitShiftBn, but takes its input by pointer.                      *
+ *  Note: Helper function not intended for use by user. out must not point to a.                         *
+\*********************************************************************************************************/
+void bitShiftBnRef(struct bignum const* a, int shift, struct bignum* out) {
     if (shift > 0) {
         (*out) = emptyBn;
 
         int wordShift = (shift / BN_WORD_SIZE);
         int wordShiftFine = (shift % BN_WORD_SIZE);
 
-        for (int i = a.highestWord; i >= 0; i--) {
-            ullong tmp = ((ullong) a.number[i]) << wordShiftFine;
+        for (int i = a->highestWord; i >= 0; i--) {
+            ullong tmp = ((ullong) a->number[i]) << wordShiftFine;
 
             out->number[wordShift + i + 1] += (uint) BN_UPPER_WORD(tmp); 
             out->number[wordShift + i] += (uint) BN_LOWER_WORD(tmp);
         }
 
-        if (out->number[wordShift + a.highestWord + 1] == 0) {
-            out->highestWord = wordShift + a.highestWord;
+        if (out->number[wordShift + a->highestWord + 1] == 0) {
+            out->highestWord = wordShift + a->highestWord;
         } else {
-            out->highestWord = wordShift + a.highestWord + 1;
+            out->highestWord = wordShift + a->highestWord + 1;
         }
     } else if (shift < 0) {
         (*out) = emptyBn;
@@ -286,8 +466,8 @@ void bitShiftBn(struct bignum a, int shift, struct bignum* out) {
         int wordShift = (shift / BN_WORD_SIZE);
         int wordShiftFine = (shift % BN_WORD_SIZE);
 
-        for (int i = 0; i < (a.highestWord + 1); i++) {
-            ullong tmp = ((ullong) a.number[i]) << (BN_WORD_SIZE - wordShiftFine);
+        for (int i = 0; i < (a->highestWord + 1); i++) {
+            ullong tmp = ((ullong) a->number[i]) << (BN_WORD_SIZE - wordShiftFine);
 
             if (i != 0) {
                 out->number[(i - wordShift) - 1] += (uint) BN_LOWER_WORD(tmp); 
@@ -295,13 +475,13 @@ void bitShiftBn(struct bignum a, int shift, struct bignum* out) {
             out->number[(i - wordShift)] += (uint) BN_UPPER_WORD(tmp);
         }
 
-        if (out->number[a.highestWord - wordShift] == 0) {
-            out->highestWord = a.highestWord - wordShift - 1;
+        if (out->number[a->highestWord - wordShift] == 0) {
+            out->highestWord = a->highestWord - wordShift - 1;
         } else {
-            out->highestWord = a.highestWord - wordShift;
+            out->highestWord = a->highestWord - wordShift;
         }
     } else {
-        (*out) = a;
+        (*out) = (*a);
     }
 }
 
@@ -349,14 +529,14 @@ void xorBnBn(struct bignum a, struct bignum b, struct bignum* out) {
 
 /*********************************************************************************************************\
  *  addBnBnNS adds a and b but ignores their sign.                                                       *
- *  Note: Helper function not intended for use by user.                                                  *
+ *  Note: Helper function not intended for use by user. out must not point to a or b.                    *
 \*********************************************************************************************************/
-void addBnBnNS(struct bignum a, struct bignum b, struct bignum* out) {
+void addBnBnNS(struct bignum const* a, struct bignum const* b, struct bignum* out) {
     (*out) = emptyBn;
-    int highestWord = fmax(a.highestWord, b.highestWord);
+    int highestWord = fmax(a->highestWord, b->highestWord);
 
     for (int i = 0; i < (highestWord + 1); i++) {
-        ullong sum = ((ullong) a.number[i]) + ((ullong) b.number[i]) + ((ullong) out->number[i]);
+        ullong sum = ((ullong) a->number[i]) + ((ullong) b->number[i]) + ((ullong) out->number[i]);
 
         out->number[i] = BN_LOWER_WORD(sum); 
         out->number[i + 1] = BN_UPPER_WORD(sum);
@@ -371,12 +551,15 @@ void addBnBnNS(struct bignum a, struct bignum b, struct bignum* out) {
 
 /*********************************************************************************************************\
  *  subBnBnNS subtracts b by a but ignores their sign.                                                   *
- *  Note: Helper function not intended for use by user.                                                  *
+ *  Note: Helper function not intended for use by user. out must not point to a or b.                    *
 \*********************************************************************************************************/
-void subBnBnNS(struct bignum a, struct bignum b, struct bignum* out) {
+void subBnBnNS(struct bignum const* a, struct bignum const* b, struct bignum* out) {
     (*out) = emptyBn;
 
-    switch (compareBn(a, b)) {
+    struct bignum const* big = a;
+    struct bignum const* small = b;
+
+    switch (compareBnRef(a, b)) {
         case 1: {
             break; 
         }
@@ -384,29 +567,26 @@ void subBnBnNS(struct bignum a, struct bignum b, struct bignum* out) {
             return;
         } 
         case -1: {
-            struct bignum tmp = a;
-            a = b;
-            b = tmp;
+            big = b;
+            small = a;
             out->sign = -1;
             break;
         }
     }
 
-    int highestWord = a.highestWord;
+    int highestWord = big->highestWord;
 
     ullong sub = 0;
     ullong carry = 0;
 
     for (int i = 0; i < (highestWord + 1); i++) {
-        if (i > b.highestWord) {
-            b.number[i] = 0;
-        }
+        ullong smallWord = (i > small->highestWord) ? 0 : ((ullong) small->number[i]);
 
-        if (((ullong) a.number[i]) >= (((ullong) b.number[i]) + carry)) {
-            sub = ((ullong) a.number[i]) - ((ullong) b.number[i]) - carry;
+        if (((ullong) big->number[i]) >= (smallWord + carry)) {
+            sub = ((ullong) big->number[i]) - smallWord - carry;
             carry = 0;
         } else {
-            sub = (((ullong) a.number[i]) ^ BN_FIRST_BIT_OF_HIGH_WORD) - ((ullong) b.number[i]) - carry;
+            sub = (((ullong) big->number[i]) ^ BN_FIRST_BIT_OF_HIGH_WORD) - smallWord - carry;
             carry = 1;
         }
 
@@ -423,82 +603,89 @@ void subBnBnNS(struct bignum a, struct bignum b, struct bignum* out) {
 
 /*********************************************************************************************************\
  *  mulBnBnNS multiplies a and b but ignores their sign.                                                 *
- *  Note: Helper function not intended for use by user.                                                  *
+ *  Note: Helper function not intended for use by user. out must not point to a or b.                    *
 \*********************************************************************************************************/
-void mulBnBnNS(struct bignum a, struct bignum b, struct bignum* out) {
+void mulBnBnNS(struct bignum const* a, struct bignum const* b, struct bignum* out) {
     (*out) = emptyBn;
 
-    for (int i = 0; i < (a.highestWord + 1); i++) {
-        struct bignum section = {0};
-        for (int j = 0; j < (b.highestWord + 1); j++) {
-            ullong prod = (ullong) a.number[i] * (ullong) b.number[j];
+    for (int i = 0; i < (a->highestWord + 1); i++) {
+        ullong carry = 0;
+        for (int j = 0; j < (b->highestWord + 1); j++) {
+            ullong prod = ((ullong) a->number[i] * (ullong) b->number[j]) + ((ullong) out->number[i + j]) + carry;
 
-            struct bignum prodShift;
-            struct bignum prodBn;
-            initBnUll(&prodBn, prod, 1);
-            shiftBn(prodBn, j, &prodShift);
-
-            struct bignum sectionTmp;
-            addBnBn(section, prodShift, &sectionTmp);
-            section = sectionTmp;
+            out->number[i + j] = BN_LOWER_WORD(prod);
+            carry = BN_UPPER_WORD(prod);
         }
-        struct bignum sectionShift;
-        shiftBn(section, i, &sectionShift);
+        out->number[i + b->highestWord + 1] = (uint) carry;
+    }
 
-        struct bignum outTmp = emptyBn;
-        addBnBn(*out, sectionShift, &outTmp);
-        (*out) = outTmp;
+    out->highestWord = a->highestWord + b->highestWord + 1;
+    while (out->highestWord > 0 && out->number[out->highestWord] == 0) {
+        out->highestWord--;
     }
 }
 
 /*********************************************************************************************************\
  *  divBnBnNS divides a by b but ignores their sign and assumes a >= b.                                  *
- *  Note: Helper function not intended for use by user.                                                  *
+ *  Note: Helper function not intended for use by user. out and remainder must not point to a or b.      *
 \*********************************************************************************************************/
-void divBnBnNS(struct bignum a, struct bignum b, struct bignum* out, struct bignum* remainder) {
+void divBnBnNS(struct bignum const* a, struct bignum const* b, struct bignum* out, struct bignum* remainder) {
     (*out) = emptyBn;
+    (*remainder) = emptyBn;
 
-    if (BN_IS_ZERO(a) || BN_IS_ZERO(b)) {
+    if (BN_IS_ZERO((*a)) || BN_IS_ZERO((*b))) {
         return;
     }
 
-    struct bignum tmp;
+    struct bnWorkspace* workspace = getBnWorkspace();
+    struct bignum* rest = takeBnWorkspace(workspace);
+    struct bignum* tmp = takeBnWorkspace(workspace);
+    struct bignum* part = takeBnWorkspace(workspace);
+    (*rest) = (*a);
 
-    int highestBitOfDivisor = (b.highestWord * BN_WORD_SIZE) + BN_INDEX_OF_HIGHEST_BIT_WORD(b.number[b.highestWord]);
+    int highestBitOfDivisor = (b->highestWord * BN_WORD_SIZE) + BN_INDEX_OF_HIGHEST_BIT_WORD(b->number[b->highestWord]);
     int highestBitOfDividend;
 
     do {
-        highestBitOfDividend = (a.highestWord * BN_WORD_SIZE) + BN_INDEX_OF_HIGHEST_BIT_WORD(a.number[a.highestWord]);
+        highestBitOfDividend = (rest->highestWord * BN_WORD_SIZE) + BN_INDEX_OF_HIGHEST_BIT_WORD(rest->number[rest->highestWord]);
 
-        struct bignum part;
-        bitShiftBn(b, highestBitOfDividend - highestBitOfDivisor, &part);
+        bitShiftBnRef(b, highestBitOfDividend - highestBitOfDivisor, part);
 
         int extraShift = 0;
-        switch (compareBn(a, part)) {
+        switch (compareBnRef(rest, part)) {
             case 1: {
-                subBnBn(a, part, &tmp);
-                a = tmp;
+                subBnBnNS(rest, part, tmp);
                 break;
             }
             case 0: {
-                a = emptyBn;
+                (*tmp) = emptyBn;
                 break;
             }
             case -1: {
-                bitShiftBn(part, -1, &tmp);
+                bitShiftBnRef(part, -1, tmp);
+                struct bignum* swap = part;
                 part = tmp;
-                subBnBn(a, part, &tmp);
-                a = tmp;
+                tmp = swap;
+                subBnBnNS(rest, part, tmp);
                 extraShift = 1;
                 break;
             }
         }
+        struct bignum* swap = rest;
+        rest = tmp;
+        tmp = swap;
+
+        int bitIndex = (highestBitOfDividend - highestBitOfDivisor) - extraShift;
+        int wordIndex = bitIndex / (int) BN_WORD_SIZE;
+        out->number[wordIndex] ^= (1u << (bitIndex % BN_WORD_SIZE));
+        if (out->highestWord < wordIndex) {
+            out->highestWord = wordIndex;
+        }
+    } while (compareBnRef(rest, b) != -1);
 
-        tmp = (*out);
-        flipBitBn(tmp, (highestBitOfDividend - highestBitOfDivisor) - extraShift, out);
-    } while (compareBn(a, b) != -1);
+    (*remainder) = (*rest);
 
-    (*remainder) = a;
+    releaseBnWorkspace(workspace, 3);
 }
 
 
@@ -506,18 +693,24 @@ void divBnBnNS(struct bignum a, struct bignum b, struct bignum* out, struct bign
  *  addBnBn adds a and b.                                                                                *
 \*********************************************************************************************************/
 void addBnBn(struct bignum a, struct bignum b, struct bignum* out) {
-    if (a.sign == 1) {
-        if (b.sign == 1) {
+    addBnBnRef(&a, &b, out);
+}
+
+/*********************************************************************************************************\
+ *  addBnBnRef functions the same as addBnBn, but takes its inputs by pointer.                           *
+ *  Note: Helper function not intended for use by user. out must not point to a or b.                    *
+\*********************************************************************************************************/
+void addBnBnRef(struct bignum const* a, struct bignum const* b, struct bignum* out) {
+    if (a->sign == 1) {
+        if (b->sign == 1) {
             addBnBnNS(a, b, out);
         } else {
             subBnBnNS(a, b, out);
         }
     } else {
-        if (b.sign == 1) {
+        if (b->sign == 1) {
             subBnBnNS(b, a, out);
         } else {
-            a.sign = 1;
-            b.sign = 1;
             addBnBnNS(a, b, out);
             out->sign = -1;
         }
@@ -528,14 +721,22 @@ void addBnBn(struct bignum a, struct bignum b, struct bignum* out) {
  *  subBnBn subtracts a by b.                                                                            *
 \*********************************************************************************************************/
 void subBnBn(struct bignum a, struct bignum b, struct bignum* out) {
-    if (a.sign == 1) {
-        if (b.sign == 1) {
+    subBnBnRef(&a, &b, out);
+}
+
+/*********************************************************************************************************\
+ *  subBnBnRef functions the same as subBnBn, but takes its inputs by pointer.                           *
+ *  Note: Helper function not intended for use by user. out must not point to a or b.                    *
+\*********************************************************************************************************/
+void subBnBnRef(struct bignum const* a, struct bignum const* b, struct bignum* out) {
+    if (a->sign == 1) {
+        if (b->sign == 1) {
             subBnBnNS(a, b, out);
         } else {
             addBnBnNS(a, b, out);
         }
     } else {
-        if (b.sign == 1) {
+        if (b->sign == 1) {
             addBnBnNS(a, b, out);
             out->sign = -1;
         } else {
@@ -548,15 +749,23 @@ void subBnBn(struct bignum a, struct bignum b, struct bignum* out) {
  *  mulBnBn multiples a and b.                                                                           *
 \*********************************************************************************************************/
 void mulBnBn(struct bignum a, struct bignum b, struct bignum* out) {
-    if (a.sign == 1) {
-        if (b.sign == 1) {
+    mulBnBnRef(&a, &b, out);
+}
+
+/*********************************************************************************************************\
+ *  mulBnBnRef functions the same as mulBnBn, but takes its inputs by pointer.                           *
+ *  Note: Helper function not intended for use by user. out must not point to a or b.                    *
+\*********************************************************************************************************/
+void mulBnBnRef(struct bignum const* a, struct bignum const* b, struct bignum* out) {
+    if (a->sign == 1) {
+        if (b->sign == 1) {
             mulBnBnNS(a, b, out);
         } else {
             mulBnBnNS(a, b, out);
             out->sign = -1;
         }
     } else {
-        if (b.sign == 1) {
+        if (b->sign == 1) {
             mulBnBnNS(a, b, out);
             out->sign = -1;
         } else {
@@ -569,20 +778,28 @@ void mulBnBn(struct bignum a, struct bignum b, struct bignum* out) {
  *  divBnBn divides a by b.                                                                              *
 \*********************************************************************************************************/
 void divBnBn(struct bignum a, struct bignum b, struct bignum* out, struct bignum* remainder) {
-    if (compareBn(a, b) == -1) {
+    divBnBnRef(&a, &b, out, remainder);
+}
+
+/*********************************************************************************************************\
+ *  divBnBnRef functions the same as divBnBn, but takes its inputs by pointer.                           *
+ *  Note: Helper function not intended for use by user. out and remainder must not point to a or b.      *
+\*********************************************************************************************************/
+void divBnBnRef(struct bignum const* a, struct bignum const* b, struct bignum* out, struct bignum* remainder) {
+    if (compareBnRef(a, b) == -1) {
         *out = emptyBn;
-        *remainder = a;
+        *remainder = *a;
         return;
     }
-    if (a.sign == 1) {
-        if (b.sign == 1) {
+    if (a->sign == 1) {
+        if (b->sign == 1) {
             divBnBnNS(a, b, out, remainder);
         } else {
             divBnBnNS(a, b, out, remainder);
             out->sign = -1;
         }
     } else {
-        if (b.sign == 1) {
+        if (b->sign == 1) {
             divBnBnNS(a, b, out, remainder);
             out->sign = -1;
         } else {
@@ -596,19 +813,33 @@ void divBnBn(struct bignum a, struct bignum b, struct bignum* out, struct bignum
  *  Note: Currently ignores sign.                                                                        *
 \*********************************************************************************************************/
 void modBnBn(struct bignum a, struct bignum b, struct bignum* out) {
-    struct bignum tmp;
-    switch (compareBn(a, b)) {
+    modBnBnRef(&a, &b, out);
+}
+
+/*********************************************************************************************************\
+ *  modBnBnRef functions the same as modBnBn, but takes its inputs by pointer.                           *
+ *  Note: Helper function not intended for use by user. out must not point to a or b.                    *
+\*********************************************************************************************************/
+void modBnBnRef(struct bignum const* a, struct bignum const* b, struct bignum* out) {
+    struct bnWorkspace* workspace = getBnWorkspace();
+    struct bignum* tmp = takeBnWorkspace(workspace);
+
+    switch (compareBnRef(a, b)) {
         case 1: {
-            divBnBnNS(a, b, &tmp, out);
+            divBnBnNS(a, b, tmp, out);
             break;
         }
         case 0: {
             (*out) = emptyBn;
+            break;
         }
         case -1: {
-            (*out) = a;
+            (*out) = (*a);
+            break;
         }
     }
+
+    releaseBnWorkspace(workspace, 1);
 }
 
 /*********************************************************************************************************\
@@ -616,75 +847,344 @@ void modBnBn(struct bignum a, struct bignum b, struct bignum* out) {
  *  gcd(a, b) = d = a*x + b*y                                                                            *
 \*********************************************************************************************************/
 void gcdBn(struct bignum a, struct bignum b, struct bignum* d, struct bignum* x, struct bignum* y) {
-	struct bignum remander = b;
-	struct bignum oldRemander = a;
-
-	struct bignum s;
-	initBnUll(&s, (ullong) 0, 1);
-	struct bignum oldS;
-	initBnUll(&oldS, (ullong) 1, 1);
-	struct bignum t;
-	initBnUll(&t, (ullong) 1, 1);
-	struct bignum oldT;
-	initBnUll(&oldT, (ullong) 0, 1);
-
-	struct bignum tmp;
-	struct bignum save;
-	struct bignum div;
-	struct bignum placeholder;
+	gcdBnRef(&a, &b, d, x, y);
+}
+
+/*********************************************************************************************************\
+ *  gcdBnRef functions the same as gcdBn, but takes its inputs by pointer.                               *
+\*********************************************************************************************************/
+void gcdBnRef(struct bignum const* a, struct bignum const* b, struct bignum* d, struct bignum* x, struct bignum* y) {
+	struct bnWorkspace* workspace = getBnWorkspace();
+
+	struct bignum* remander = takeBnWorkspace(workspace);
+	*remander = *b;
+	struct bignum* oldRemander = takeBnWorkspace(workspace);
+	*oldRemander = *a;
+
+	struct bignum* s = takeBnWorkspace(workspace);
+	initBnUll(s, (ullong) 0, 1);
+	struct bignum* oldS = takeBnWorkspace(workspace);
+	initBnUll(oldS, (ullong) 1, 1);
+	struct bignum* t = takeBnWorkspace(workspace);
+	initBnUll(t, (ullong) 1, 1);
+	struct bignum* oldT = takeBnWorkspace(workspace);
+	initBnUll(oldT, (ullong) 0, 1);
+
+	struct bignum* tmp = takeBnWorkspace(workspace);
+	struct bignum* save = takeBnWorkspace(workspace);
+	struct bignum* div = takeBnWorkspace(workspace);
+	struct bignum* placeholder = takeBnWorkspace(workspace);
     
 	do {
-		divBnBn(oldRemander, remander, &div, &placeholder);
+		divBnBnRef(oldRemander, remander, div, placeholder);
 		// Euclidean Algorithem
-		save = remander;
-		mulBnBn(div, remander, &tmp);
-		subBnBn(oldRemander, tmp, &remander);
-		oldRemander = save;
+		*save = *remander;
+		mulBnBnRef(div, remander, tmp);
+		subBnBnRef(oldRemander, tmp, remander);
+		*oldRemander = *save;
 
 		// Extended Euclidean Algorithem
-		save = s;
-		mulBnBn(div, s, &tmp);
-		subBnBn(oldS, tmp, &s);
-		oldS = save;
+		*save = *s;
+		mulBnBnRef(div, s, tmp);
+		subBnBnRef(oldS, tmp, s);
+		*oldS = *save;
 
-		save = t;
-		mulBnBn(div, t, &tmp);
-		subBnBn(oldT, tmp, &t);
-		oldT = save;
+		*save = *t;
+		mulBnBnRef(div, t, tmp);
+		subBnBnRef(oldT, tmp, t);
+		*oldT = *save;
 
-	} while (compareBn(remander, emptyBn) == 1);
+	} while (compareBnRef(remander, &emptyBn) == 1);
 	
-	*d = oldRemander;
-	*x = oldS;
-	*y = oldT;
+	*d = *oldRemander;
+	*x = *oldS;
+	*y = *oldT;
+
+	releaseBnWorkspace(workspace, 10);
 }
 
 /*********************************************************************************************************\
  *  modExponentiation computes base ^ exponent % modulus = ans.                                          *
 \*********************************************************************************************************/
 void modExponentiation(struct bignum base, struct bignum exponent, struct bignum modulus, struct bignum* out) {
-	struct bignum answer = oneBn;
-	struct bignum tmp = emptyBn;
-	struct bignum tmp2 = emptyBn;
-    
-	while (!compareBnIgnoreSize(exponent, emptyBn)) {
-		andBnBn(exponent, oneBn, &tmp);
+	modExponentiationRef(&base, &exponent, &modulus, out);
+}
 
-		if (compareBnIgnoreSize(tmp, oneBn)) {
-			mulBnBn(answer, base, &tmp);
-			modBnBn(tmp, modulus, &answer);
+/*********************************************************************************************************\
+ *  modExponentiationRef functions the same as modExponentiation, but takes its inputs by pointer.       *
+ *  Note: out must not point to modulus.                                                                 *
+\*********************************************************************************************************/
+void modExponentiationRef(struct bignum const* base, struct bignum const* exponent, struct bignum const* modulus, struct bignum* out) {
+	struct bnWorkspace* workspace = getBnWorkspace();
+	struct bignum* answer = takeBnWorkspace(workspace);
+	*answer = oneBn;
+	struct bignum* tmp = takeBnWorkspace(workspace);
+	struct bignum* current = takeBnWorkspace(workspace);
+	*current = *base;
+	struct bignum* remaining = takeBnWorkspace(workspace);
+	*remaining = *exponent;
+    
+	while (remaining->highestWord > 0 || remaining->number[0] != 0) {
+		if ((remaining->number[0] & 1) == 1) {
+			mulBnBnRef(answer, current, tmp);
+			modBnBnRef(tmp, modulus, answer);
 
-			tmp = exponent;
-			xorBnBn(tmp, oneBn, &exponent);
+			remaining->number[0] ^= 1;
 		}
 
-		tmp2 = base;
-		mulBnBn(base, tmp2, &tmp);
-		modBnBn(tmp, modulus, &base);
+		mulBnBnRef(current, current, tmp);
+		modBnBnRef(tmp, modulus, current);
 
-		tmp = exponent;
-		bitShiftBn(tmp, -1, &exponent);
+		bitShiftBnRef(remaining, -1, tmp);
+		*remaining = *tmp;
 	}
 
-	modBnBn(answer, modulus, out);
-}
\ No newline at end of file
+	modBnBnRef(answer, modulus, out);
+
+	releaseBnWorkspace(workspace, 4);
+}
+
+/*********************************************************************************************************\
+ *  initBnReducer prepares a reducer for computing (byte stream) % modulus.                              *
+ *  Returns:                                                                                             *
+ *      true:  reducer is ready                                                                          *
+ *      false: modulus is zero or memory could not be allocated; feeding the reducer does nothing and    *
+ *             finalBnReducer returns 0                                                                  *
+ *  Note: Sign of modulus is ignored.                                                                    *
+ *  Note: Call freeBnReducer when done, whether or not this succeeded.                                   *
+\*********************************************************************************************************/
+bool initBnReducer(struct bnReducer* reducer, struct bignum const* modulus) {
+    reducer->memory = NULL;
+    reducer->modulusWords = 0;
+    reducer->filledWords = 0;
+    reducer->pendingWord = 0;
+    reducer->pendingBytes = 0;
+
+    int highestWord = modulus->highestWord;
+    while (highestWord > 0 && modulus->number[highestWord] == 0) {
+        highestWord--;
+    }
+    if (modulus->number[highestWord] == 0) {
+        return false;
+    }
+
+    int n = highestWord + 1;
+    /* modulus, residue and block take n words each, acc 2n + 1 and table (n + 1) * n */
+    size_t words = (size_t) (5 * n + 1) + ((size_t) (n + 1) * n);
+    uint* memory = (uint*) calloc(words, sizeof(uint));
+    if (memory == NULL) {
+        return false;
+    }
+    reducer->memory = memory;
+    reducer->modulus = memory;
+    reducer->residue = reducer->modulus + n;
+    reducer->block = reducer->residue + n;
+    reducer->acc = reducer->block + n;
+    reducer->table = reducer->acc + (2 * n + 1);
+
+    int shift = __builtin_clz(modulus->number[highestWord]);
+    reducer->modulusWords = n;
+    reducer->normShift = shift;
+
+    for (int i = n - 1; i >= 0; i--) {
+        uint low = (shift != 0 && i > 0) ? (modulus->number[i - 1] >> (BN_WORD_SIZE - shift)) : 0;
+        reducer->modulus[i] = (modulus->number[i] << shift) | low;
+    }
+
+    /* Row 0 of table = 2^(32 * n) % modulus, which is 2^(32 * n) - modulus unless that equals modulus */
+    ullong borrow = 0;
+    for (int j = 0; j < n; j++) {
+        ullong sub = ((ullong) 0) - ((ullong) reducer->modulus[j]) - borrow;
+        reducer->table[j] = (uint) BN_LOWER_WORD(sub);
+        borrow = BN_UPPER_WORD(sub) & 1;
+    }
+    if (memcmp(reducer->table, reducer->modulus, n * sizeof(uint)) == 0) {
+        memset(reducer->table, 0, n * sizeof(uint));
+    }
+
+    /* Row i + 1 of table = row i * 2^32 % modulus */
+    for (int i = 0; i < n; i++) {
+        addMulBnReducer(reducer, 1, reducer->table + (i * n), n, 1);
+        foldBnReducer(reducer);
+        memcpy(reducer->table + ((i + 1) * n), reducer->acc, n * sizeof(uint));
+        memset(reducer->acc, 0, n * sizeof(uint));
+    }
+
+    return true;
+}
+
+/*********************************************************************************************************\
+ *  addMulBnReducer adds x * w, shifted up by offset words, to reducer->acc.                             *
+ *  Note: Helper function not intended for use by user.                                                  *
+\*********************************************************************************************************/
+void addMulBnReducer(struct bnReducer* reducer, int offset, uint const x[], int length, uint w) {
+    int accWords = 2 * reducer->modulusWords + 1;
+    ullong carry = 0;
+
+    for (int j = 0; j < length; j++) {
+        ullong sum = ((ullong) w * (ullong) x[j]) + ((ullong) reducer->acc[offset + j]) + carry;
+        reducer->acc[offset + j] = (uint) BN_LOWER_WORD(sum);
+        carry = BN_UPPER_WORD(sum);
+    }
+    for (int j = offset + length; carry != 0 && j < accWords; j++) {
+        ullong sum = ((ullong) reducer->acc[j]) + carry;
+        reducer->acc[j] = (uint) BN_LOWER_WORD(sum);
+        carry = BN_UPPER_WORD(sum);
+    }
+}
+
+/*********************************************************************************************************\
+ *  foldBnReducer reduces reducer->acc (at most 2n words) in place so that acc < modulus.                *
+ *  Words above n are folded back in with table multiply-accumulates. Word n is then removed with a      *
+ *  quotient estimated from the top two words, and a final conditional subtract finishes the job.        *
+ *  Note: Helper function not intended for use by user.                                                  *
+\*********************************************************************************************************/
+void foldBnReducer(struct bnReducer* reducer) {
+    int n = reducer->modulusWords;
+    uint* acc = reducer->acc;
+
+    bool folded = true;
+    while (folded) {
+        folded = false;
+        for (int i = 2 * n; i > n; i--) {
+            uint w = acc[i];
+            if (w != 0) {
+                acc[i] = 0;
+                addMulBnReducer(reducer, 0, reducer->table + ((i - n) * n), n, w);
+                folded = true;
+            }
+        }
+    }
+
+    /* quotient = top / (modulus[n - 1] + 1) never overshoots, and falls short by at most a few */
+    while (acc[n] != 0) {
+        ullong top = (((ullong) acc[n]) << BN_WORD_SIZE) | acc[n - 1];
+        ullong quotient = top / (((ullong) reducer->modulus[n - 1]) + 1);
+        if (quotient > UINT_MAX) {
+            quotient = UINT_MAX;
+        }
+
+        ullong carry = 0;
+        ullong borrow = 0;
+        for (int j = 0; j < n; j++) {
+            ullong prod = (quotient * (ullong) reducer->modulus[j]) + carry;
+            carry = BN_UPPER_WORD(prod);
+            ullong sub = ((ullong) acc[j]) - BN_LOWER_WORD(prod) - borrow;
+            acc[j] = (uint) BN_LOWER_WORD(sub);
+            borrow = BN_UPPER_WORD(sub) & 1;
+        }
+        acc[n] -= (uint) (carry + borrow);
+    }
+
+    int compare = 0;
+    for (int j = n - 1; j >= 0 && compare == 0; j--) {
+        if (acc[j] > reducer->modulus[j]) {
+            compare = 1;
+        } else if (acc[j] < reducer->modulus[j]) {
+            compare = -1;
+        }
+    }
+    if (compare != -1) {
+        ullong borrow = 0;
+        for (int j = 0; j < n; j++) {
+            ullong sub = ((ullong) acc[j]) - ((ullong) reducer->modulus[j]) - borrow;
+            acc[j] = (uint) BN_LOWER_WORD(sub);
+            borrow = BN_UPPER_WORD(sub) & 1;
+        }
+    }
+}
+
+/*********************************************************************************************************\
+ *  feedBnReducer appends length bytes to the stream. Each full block of n words costs n word * table    *
+ *  multiply-accumulates: residue * 2^(32 * n) + block = block + sum(residue[i] * table[i]).             *
+\*********************************************************************************************************/
+void feedBnReducer(struct bnReducer* reducer, unsigned char const bytes[], size_t length) {
+    int n = reducer->modulusWords;
+    if (n == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        reducer->pendingWord = (reducer->pendingWord << 8) | bytes[i];
+        reducer->pendingBytes++;
+
+        if (reducer->pendingBytes == sizeof(uint)) {
+            /* Words arrive highest first, so store them from the top of block down */
+            reducer->block[n - 1 - reducer->filledWords] = reducer->pendingWord;
+            reducer->filledWords++;
+            reducer->pendingWord = 0;
+            reducer->pendingBytes = 0;
+
+            if (reducer->filledWords == n) {
+                addMulBnReducer(reducer, 0, reducer->block, n, ((uint) 1) << reducer->normShift);
+                for (int j = 0; j < n; j++) {
+                    if (reducer->residue[j] != 0) {
+                        addMulBnReducer(reducer, 0, reducer->table + (j * n), n, reducer->residue[j]);
+                    }
+                }
+                foldBnReducer(reducer);
+
+                memcpy(reducer->residue, reducer->acc, n * sizeof(uint));
+                memset(reducer->acc, 0, (n + 1) * sizeof(uint));
+                reducer->filledWords = 0;
+            }
+        }
+    }
+}
+
+/*********************************************************************************************************\
+ *  finalBnReducer folds in any partial block and returns (byte stream) % modulus.                       *
+ *  Note: The reducer is reset afterwards, so it can be reused with the same modulus.                    *
+\*********************************************************************************************************/
+void finalBnReducer(struct bnReducer* reducer, struct bignum* out) {
+    (*out) = emptyBn;
+
+    int n = reducer->modulusWords;
+    if (n == 0) {
+        return;
+    }
+
+    int filled = reducer->filledWords;
+    int shift = (filled * BN_WORD_SIZE) + (reducer->pendingBytes * 8);
+
+    if (shift != 0) {
+        /* acc = residue << shift + (tail words << (pending bits) + pendingWord) << normShift */
+        addMulBnReducer(reducer, shift / BN_WORD_SIZE, reducer->residue, n, ((uint) 1) << (shift % BN_WORD_SIZE));
+
+        int tailShift = (reducer->pendingBytes * 8) + reducer->normShift;
+        addMulBnReducer(reducer, tailShift / BN_WORD_SIZE, &reducer->block[n - filled], filled, ((uint) 1) << (tailShift % BN_WORD_SIZE));
+        if (reducer->pendingBytes != 0) {
+            addMulBnReducer(reducer, 0, &reducer->pendingWord, 1, ((uint) 1) << reducer->normShift);
+        }
+
+        foldBnReducer(reducer);
+        memcpy(reducer->residue, reducer->acc, n * sizeof(uint));
+        memset(reducer->acc, 0, (n + 1) * sizeof(uint));
+    }
+
+    /* Undo the normalization shift */
+    int normShift = reducer->normShift;
+    for (int j = 0; j < n; j++) {
+        uint high = (normShift != 0 && j + 1 < n) ? (reducer->residue[j + 1] << (BN_WORD_SIZE - normShift)) : 0;
+        out->number[j] = (reducer->residue[j] >> normShift) | high;
+        if (out->number[j] != 0) {
+            out->highestWord = j;
+        }
+        reducer->residue[j] = 0;
+    }
+
+    reducer->filledWords = 0;
+    reducer->pendingWord = 0;
+    reducer->pendingBytes = 0;
+}
+
+/*********************************************************************************************************\
+ *  freeBnReducer returns the memory held by a reducer, which must be initialized again before reuse.    *
+\*********************************************************************************************************/
+void freeBnReducer(struct bnReducer* reducer) {
+    free(reducer->memory);
+    reducer->memory = NULL;
+    reducer->modulusWords = 0;
+}
+
+#endif
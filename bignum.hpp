@@ -0,0 +1,508 @@
+#ifndef BIGNUM_HPP
+#define BIGNUM_HPP
+
+#include <type_traits>
+
+#include "bignum.h"
+
+/* Marks loops whose trip count is fixed by the template width, so the compiler can flatten them */
+#define BN_UNROLL _Pragma("GCC unroll 64")
+
+/*********************************************************************************************************\
+ *  Each BigUInt<Bits> is a fixed width unsigned bignum of ceil(Bits / 32) words, stored like bignum.    *
+ *  number[0] is the lowest word. There is no highestWord or sign: every operation touches all words,    *
+ *  and +, -, * and << wrap modulo 2^(32 * words). All arithmetic is constexpr.                          *
+ *  Word-by-word loops (add, sub, logic, shifts, multiply, Montgomery multiply) run over all words and   *
+ *  are unrolled. compareBig, highestBit, divModBig and powMod stop or iterate on the data, so they are  *
+ *  not.                                                                                                 *
+ *  Note: Requires C++17.                                                                                *
+\*********************************************************************************************************/
+template <int Bits>
+struct BigUInt {
+    static_assert(Bits > 0, "BigUInt needs at least one bit");
+
+    static constexpr int words = (Bits + BN_WORD_SIZE - 1) / BN_WORD_SIZE;
+    static constexpr int bits = words * BN_WORD_SIZE;
+
+    uint number[words];
+
+    constexpr BigUInt() : number{} {}
+
+    static constexpr BigUInt fromUll(ullong value);
+    static constexpr BigUInt fromHex(char const* hex);
+    static BigUInt fromBn(struct bignum const& bn);
+    void toBn(struct bignum* out) const;
+
+    constexpr bool isZero() const;
+    constexpr bool bit(int bitIndex) const;
+    constexpr int highestBit() const;
+
+    constexpr uint addInPlace(BigUInt const& b);
+    constexpr uint subInPlace(BigUInt const& b);
+    constexpr uint shiftLeftOneInPlace();
+};
+
+/*********************************************************************************************************\
+ *  fromUll initializes a BigUInt with an unsigned long long (ullong).                                   *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr BigUInt<Bits> BigUInt<Bits>::fromUll(ullong value) {
+    BigUInt out;
+    out.number[0] = (uint) BN_LOWER_WORD(value);
+    if constexpr (words > 1) {
+        out.number[1] = (uint) BN_UPPER_WORD(value);
+    }
+    return out;
+}
+
+/*********************************************************************************************************\
+ *  fromHex initializes a BigUInt with a hex string ("0x" not included). Usable at compile time.         *
+ *  Note: Digits beyond the width of the BigUInt are dropped.                                            *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr BigUInt<Bits> BigUInt<Bits>::fromHex(char const* hex) {
+    BigUInt out;
+    int stringLen = 0;
+    while (hex[stringLen] != '\0') {
+        stringLen++;
+    }
+
+    for (int i = 0; i < stringLen && i < words * 8; i++) {
+        char c = hex[stringLen - 1 - i];
+        uint digit = 0;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        }
+        out.number[i / 8] |= digit << ((i % 8) * 4);
+    }
+    return out;
+}
+
+/*********************************************************************************************************\
+ *  fromBn converts a bignum into a BigUInt. Words above the width of the BigUInt are dropped.           *
+ *  Note: Sign of bignum is ignored.                                                                     *
+\*********************************************************************************************************/
+template <int Bits>
+BigUInt<Bits> BigUInt<Bits>::fromBn(struct bignum const& bn) {
+    BigUInt out;
+    BN_UNROLL
+    for (int i = 0; i < words; i++) {
+        if (i <= bn.highestWord) {
+            out.number[i] = bn.number[i];
+        }
+    }
+    return out;
+}
+
+/*********************************************************************************************************\
+ *  toBn converts a BigUInt into a positive bignum with highestWord pointing at its top non-zero word.   *
+\*********************************************************************************************************/
+template <int Bits>
+void BigUInt<Bits>::toBn(struct bignum* out) const {
+    (*out) = emptyBn;
+    BN_UNROLL
+    for (int i = 0; i < words; i++) {
+        out->number[i] = number[i];
+        if (number[i] != 0) {
+            out->highestWord = i;
+        }
+    }
+}
+
+/*********************************************************************************************************\
+ *  isZero, bit and highestBit mirror BN_IS_ZERO and BN_INDEX_OF_HIGHEST_BIT (highestBit of 0 is 0).     *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr bool BigUInt<Bits>::isZero() const {
+    uint any = 0;
+    BN_UNROLL
+    for (int i = 0; i < words; i++) {
+        any |= number[i];
+    }
+    return any == 0;
+}
+
+template <int Bits>
+constexpr bool BigUInt<Bits>::bit(int bitIndex) const {
+    return (number[bitIndex / BN_WORD_SIZE] >> (bitIndex % BN_WORD_SIZE)) & 1;
+}
+
+template <int Bits>
+constexpr int BigUInt<Bits>::highestBit() const {
+    for (int i = words - 1; i >= 0; i--) {
+        if (number[i] != 0) {
+            return BN_INDEX_OF_HIGHEST_BIT_WORD(number[i]) + i * BN_WORD_SIZE;
+        }
+    }
+    return 0;
+}
+
+/*********************************************************************************************************\
+ *  addInPlace, subInPlace and shiftLeftOneInPlace modify this BigUInt and return the carry out.         *
+ *  Note: Helper functions used by the operators below.                                                  *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr uint BigUInt<Bits>::addInPlace(BigUInt const& b) {
+    ullong carry = 0;
+    BN_UNROLL
+    for (int i = 0; i < words; i++) {
+        ullong sum = ((ullong) number[i]) + ((ullong) b.number[i]) + carry;
+        number[i] = (uint) BN_LOWER_WORD(sum);
+        carry = BN_UPPER_WORD(sum);
+    }
+    return (uint) carry;
+}
+
+template <int Bits>
+constexpr uint BigUInt<Bits>::subInPlace(BigUInt const& b) {
+    ullong borrow = 0;
+    BN_UNROLL
+    for (int i = 0; i < words; i++) {
+        ullong sub = ((ullong) number[i]) - ((ullong) b.number[i]) - borrow;
+        number[i] = (uint) BN_LOWER_WORD(sub);
+        borrow = BN_UPPER_WORD(sub) & 1;
+    }
+    return (uint) borrow;
+}
+
+template <int Bits>
+constexpr uint BigUInt<Bits>::shiftLeftOneInPlace() {
+    uint carry = 0;
+    BN_UNROLL
+    for (int i = 0; i < words; i++) {
+        uint next = number[i] >> (BN_WORD_SIZE - 1);
+        number[i] = (number[i] << 1) | carry;
+        carry = next;
+    }
+    return carry;
+}
+
+/*********************************************************************************************************\
+ *  compareBig compares the size of two BigUInts.                                                        *
+ *  Returns:                                                                                             *
+ *      0: a == b                                                                                        *
+ *      1: a >  b                                                                                        *
+ *     -1: a <  b                                                                                        *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr int compareBig(BigUInt<Bits> const& a, BigUInt<Bits> const& b) {
+    for (int i = BigUInt<Bits>::words - 1; i >= 0; i--) {
+        if (a.number[i] > b.number[i]) {
+            return 1;
+        } else if (a.number[i] < b.number[i]) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+template <int Bits>
+constexpr bool operator==(BigUInt<Bits> const& a, BigUInt<Bits> const& b) { return compareBig(a, b) == 0; }
+template <int Bits>
+constexpr bool operator!=(BigUInt<Bits> const& a, BigUInt<Bits> const& b) { return compareBig(a, b) != 0; }
+template <int Bits>
+constexpr bool operator<(BigUInt<Bits> const& a, BigUInt<Bits> const& b) { return compareBig(a, b) == -1; }
+template <int Bits>
+constexpr bool operator<=(BigUInt<Bits> const& a, BigUInt<Bits> const& b) { return compareBig(a, b) != 1; }
+template <int Bits>
+constexpr bool operator>(BigUInt<Bits> const& a, BigUInt<Bits> const& b) { return compareBig(a, b) == 1; }
+template <int Bits>
+constexpr bool operator>=(BigUInt<Bits> const& a, BigUInt<Bits> const& b) { return compareBig(a, b) != -1; }
+
+/*********************************************************************************************************\
+ *  Logic operators perform a logical or, and, xor on the words of a and b.                              *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr BigUInt<Bits> operator|(BigUInt<Bits> a, BigUInt<Bits> const& b) {
+    BN_UNROLL
+    for (int i = 0; i < BigUInt<Bits>::words; i++) {
+        a.number[i] |= b.number[i];
+    }
+    return a;
+}
+
+template <int Bits>
+constexpr BigUInt<Bits> operator&(BigUInt<Bits> a, BigUInt<Bits> const& b) {
+    BN_UNROLL
+    for (int i = 0; i < BigUInt<Bits>::words; i++) {
+        a.number[i] &= b.number[i];
+    }
+    return a;
+}
+
+template <int Bits>
+constexpr BigUInt<Bits> operator^(BigUInt<Bits> a, BigUInt<Bits> const& b) {
+    BN_UNROLL
+    for (int i = 0; i < BigUInt<Bits>::words; i++) {
+        a.number[i] ^= b.number[i];
+    }
+    return a;
+}
+
+/*********************************************************************************************************\
+ *  Shift operators shift the bits of a by a non-negative amount. Bits shifted out are dropped.          *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr BigUInt<Bits> operator<<(BigUInt<Bits> const& a, int shift) {
+    BigUInt<Bits> out;
+    int wordShift = (shift / BN_WORD_SIZE);
+    int wordShiftFine = (shift % BN_WORD_SIZE);
+
+    BN_UNROLL
+    for (int i = BigUInt<Bits>::words - 1; i >= 0; i--) {
+        if (i - wordShift >= 0) {
+            ullong tmp = ((ullong) a.number[i - wordShift]) << wordShiftFine;
+            out.number[i] |= (uint) BN_LOWER_WORD(tmp);
+            if (i + 1 < BigUInt<Bits>::words) {
+                out.number[i + 1] |= (uint) BN_UPPER_WORD(tmp);
+            }
+        }
+    }
+    return out;
+}
+
+template <int Bits>
+constexpr BigUInt<Bits> operator>>(BigUInt<Bits> const& a, int shift) {
+    BigUInt<Bits> out;
+    int wordShift = (shift / BN_WORD_SIZE);
+    int wordShiftFine = (shift % BN_WORD_SIZE);
+
+    BN_UNROLL
+    for (int i = 0; i < BigUInt<Bits>::words; i++) {
+        if (i + wordShift < BigUInt<Bits>::words) {
+            ullong tmp = ((ullong) a.number[i + wordShift]) << (BN_WORD_SIZE - wordShiftFine);
+            out.number[i] |= (uint) BN_UPPER_WORD(tmp);
+            if (i > 0) {
+                out.number[i - 1] |= (uint) BN_LOWER_WORD(tmp);
+            }
+        }
+    }
+    return out;
+}
+
+/*********************************************************************************************************\
+ *  Arithmetic operators add, subtract and multiply modulo 2^(32 * words).                               *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr BigUInt<Bits> operator+(BigUInt<Bits> a, BigUInt<Bits> const& b) {
+    a.addInPlace(b);
+    return a;
+}
+
+template <int Bits>
+constexpr BigUInt<Bits> operator-(BigUInt<Bits> a, BigUInt<Bits> const& b) {
+    a.subInPlace(b);
+    return a;
+}
+
+/*********************************************************************************************************\
+ *  mulWideBig multiplies a and b into a BigUInt twice as wide, so no bits are lost.                     *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr BigUInt<2 * BigUInt<Bits>::bits> mulWideBig(BigUInt<Bits> const& a, BigUInt<Bits> const& b) {
+    BigUInt<2 * BigUInt<Bits>::bits> out;
+
+    BN_UNROLL
+    for (int i = 0; i < BigUInt<Bits>::words; i++) {
+        ullong carry = 0;
+        BN_UNROLL
+        for (int j = 0; j < BigUInt<Bits>::words; j++) {
+            ullong prod = ((ullong) a.number[i] * (ullong) b.number[j]) + ((ullong) out.number[i + j]) + carry;
+
+            out.number[i + j] = (uint) BN_LOWER_WORD(prod);
+            carry = BN_UPPER_WORD(prod);
+        }
+        out.number[i + BigUInt<Bits>::words] = (uint) carry;
+    }
+    return out;
+}
+
+template <int Bits>
+constexpr BigUInt<Bits> operator*(BigUInt<Bits> const& a, BigUInt<Bits> const& b) {
+    BigUInt<2 * BigUInt<Bits>::bits> wide = mulWideBig(a, b);
+    BigUInt<Bits> out;
+
+    BN_UNROLL
+    for (int i = 0; i < BigUInt<Bits>::words; i++) {
+        out.number[i] = wide.number[i];
+    }
+    return out;
+}
+
+/*********************************************************************************************************\
+ *  divModBig divides a by b one bit at a time, as divBnBnNS does. a and b may have different widths.    *
+ *  Note: Like divBnBnNS, dividing by zero gives a quotient and remainder of zero.                       *
+\*********************************************************************************************************/
+template <int ABits, int BBits>
+constexpr void divModBig(BigUInt<ABits> const& a, BigUInt<BBits> const& b, BigUInt<ABits>* out, BigUInt<BBits>* remainder) {
+    (*out) = BigUInt<ABits>();
+    (*remainder) = BigUInt<BBits>();
+
+    if (b.isZero()) {
+        return;
+    }
+
+    for (int i = a.highestBit() - 1; i >= 0; i--) {
+        uint carry = remainder->shiftLeftOneInPlace();
+        remainder->number[0] |= (uint) a.bit(i);
+
+        if (carry != 0 || compareBig(*remainder, b) != -1) {
+            remainder->subInPlace(b);
+            out->number[i / BN_WORD_SIZE] |= 1u << (i % BN_WORD_SIZE);
+        }
+    }
+}
+
+template <int Bits>
+constexpr BigUInt<Bits> operator/(BigUInt<Bits> const& a, BigUInt<Bits> const& b) {
+    BigUInt<Bits> out;
+    BigUInt<Bits> remainder;
+    divModBig(a, b, &out, &remainder);
+    return out;
+}
+
+template <int Bits>
+constexpr BigUInt<Bits> operator%(BigUInt<Bits> const& a, BigUInt<Bits> const& b) {
+    BigUInt<Bits> out;
+    BigUInt<Bits> remainder;
+    divModBig(a, b, &out, &remainder);
+    return remainder;
+}
+
+/*********************************************************************************************************\
+ *  montgomeryNPrimeBig computes -n^-1 % 2^32 for an odd low word n by Newton iteration.                 *
+ *  Note: Helper function not intended for use by user.                                                  *
+\*********************************************************************************************************/
+constexpr uint montgomeryNPrimeBig(uint n) {
+    uint inverse = 1;
+    for (int i = 0; i < 5; i++) {
+        inverse *= 2 - n * inverse;
+    }
+    return (uint) 0 - inverse;
+}
+
+/*********************************************************************************************************\
+ *  montgomeryR2Big computes R^2 % modulus, where R = 2^(32 * words), by doubling 1 (2 * bits) times.    *
+ *  Note: Helper function not intended for use by user.                                                  *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr BigUInt<Bits> montgomeryR2Big(BigUInt<Bits> const& modulus) {
+    BigUInt<Bits> out = BigUInt<Bits>::fromUll(1) % modulus;
+
+    for (int i = 0; i < 2 * BigUInt<Bits>::bits; i++) {
+        uint carry = out.shiftLeftOneInPlace();
+        if (carry != 0 || compareBig(out, modulus) != -1) {
+            out.subInPlace(modulus);
+        }
+    }
+    return out;
+}
+
+/*********************************************************************************************************\
+ *  montgomeryMulBig computes a * b * R^-1 % modulus (CIOS method). Requires a, b < modulus.             *
+ *  Note: Helper function not intended for use by user.                                                  *
+\*********************************************************************************************************/
+template <int Bits>
+constexpr BigUInt<Bits> montgomeryMulBig(BigUInt<Bits> const& a, BigUInt<Bits> const& b, BigUInt<Bits> const& modulus, uint nPrime) {
+    constexpr int words = BigUInt<Bits>::words;
+    uint t[words + 2] = {};
+
+    BN_UNROLL
+    for (int i = 0; i < words; i++) {
+        ullong carry = 0;
+        BN_UNROLL
+        for (int j = 0; j < words; j++) {
+            ullong sum = ((ullong) a.number[j] * (ullong) b.number[i]) + ((ullong) t[j]) + carry;
+            t[j] = (uint) BN_LOWER_WORD(sum);
+            carry = BN_UPPER_WORD(sum);
+        }
+        ullong sum = ((ullong) t[words]) + carry;
+        t[words] = (uint) BN_LOWER_WORD(sum);
+        t[words + 1] = (uint) BN_UPPER_WORD(sum);
+
+        uint m = t[0] * nPrime;
+        sum = ((ullong) m * (ullong) modulus.number[0]) + ((ullong) t[0]);
+        carry = BN_UPPER_WORD(sum);
+        BN_UNROLL
+        for (int j = 1; j < words; j++) {
+            sum = ((ullong) m * (ullong) modulus.number[j]) + ((ullong) t[j]) + carry;
+            t[j - 1] = (uint) BN_LOWER_WORD(sum);
+            carry = BN_UPPER_WORD(sum);
+        }
+        sum = ((ullong) t[words]) + carry;
+        t[words - 1] = (uint) BN_LOWER_WORD(sum);
+        t[words] = t[words + 1] + (uint) BN_UPPER_WORD(sum);
+    }
+
+    BigUInt<Bits> out;
+    BN_UNROLL
+    for (int i = 0; i < words; i++) {
+        out.number[i] = t[i];
+    }
+    if (t[words] != 0 || compareBig(out, modulus) != -1) {
+        out.subInPlace(modulus);
+    }
+    return out;
+}
+
+/*********************************************************************************************************\
+ *  MontgomeryBig<Modulus> does modular arithmetic with a modulus known at compile time. Modulus is a    *
+ *  type with a static constexpr BigUInt member named value, which must be odd. nPrime, r2 and one are   *
+ *  computed by the compiler.                                                                            *
+ *  Example:                                                                                             *
+ *      struct P256 { static constexpr BigUInt<256> value = BigUInt<256>::fromHex("ffff...ffff"); };     *
+ *      BigUInt<256> c = MontgomeryBig<P256>::powMod(a, b);                                              *
+\*********************************************************************************************************/
+template <typename Modulus>
+struct MontgomeryBig {
+    typedef typename std::remove_cv<decltype(Modulus::value)>::type Int;
+
+    static_assert((Modulus::value.number[0] & 1) == 1, "MontgomeryBig requires an odd modulus");
+
+    static constexpr Int modulus = Modulus::value;
+    static constexpr uint nPrime = montgomeryNPrimeBig(Modulus::value.number[0]);
+    static constexpr Int r2 = montgomeryR2Big(Modulus::value);
+    static constexpr Int one = montgomeryMulBig(Int::fromUll(1) % Modulus::value, r2, Modulus::value, nPrime);
+
+    /* Conversion into and out of Montgomery form (a * R % modulus). Requires a < modulus. */
+    static constexpr Int toMont(Int const& a) { return montgomeryMulBig(a, r2, modulus, nPrime); }
+    static constexpr Int fromMont(Int const& a) { return montgomeryMulBig(a, Int::fromUll(1), modulus, nPrime); }
+
+    /* Arithmetic on numbers in Montgomery form */
+    static constexpr Int mul(Int const& a, Int const& b) { return montgomeryMulBig(a, b, modulus, nPrime); }
+    static constexpr Int add(Int a, Int const& b) {
+        uint carry = a.addInPlace(b);
+        if (carry != 0 || compareBig(a, modulus) != -1) {
+            a.subInPlace(modulus);
+        }
+        return a;
+    }
+    static constexpr Int sub(Int a, Int const& b) {
+        if (a.subInPlace(b) != 0) {
+            a.addInPlace(modulus);
+        }
+        return a;
+    }
+
+    /* mulMod and powMod take and return ordinary numbers. Requires a, base < modulus. */
+    static constexpr Int mulMod(Int const& a, Int const& b) { return fromMont(mul(toMont(a), toMont(b))); }
+    static constexpr Int powMod(Int const& base, Int const& exponent) {
+        Int montBase = toMont(base);
+        Int answer = one;
+        for (int i = exponent.highestBit() - 1; i >= 0; i--) {
+            answer = mul(answer, answer);
+            if (exponent.bit(i)) {
+                answer = mul(answer, montBase);
+            }
+        }
+        return fromMont(answer);
+    }
+};
+
+#undef BN_UNROLL
+
+#endif